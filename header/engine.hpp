@@ -1,7 +1,10 @@
 #pragma once
 
 #include <cmath>
+#include <deque>
 #include <functional>
+#include <limits>
+#include <string>
 #include <unordered_set>
 #include <vector>
 #include <algorithm>
@@ -22,6 +25,13 @@ public:
         std::string op)
       : data(data), grad(0), backward_(backward), op_(op), prev_(std::move(prev)) {}
 
+  // Graph nodes are referenced by address (prev_ and the backward_ captures),
+  // so a copy would silently detach from the graph. Values can only be moved.
+  Value(const Value&) = delete;
+  Value& operator=(const Value&) = delete;
+  Value(Value&&) = default;
+  Value& operator=(Value&&) = default;
+
   // Backward Propagation, Topological Sort
   void backward() {
     // Seed the output gradient
@@ -45,123 +55,146 @@ public:
   }
 };
 
-inline Value operator+(Value& a, Value& b) {
-  Value out(
-      a.data + b.data,
-      {&a, &b},
-      [&a, &b, &out]() {
-        a.grad += out.grad;
-        b.grad += out.grad;
-      },
-      "+");
+// Every node produced by an operation is allocated here. std::deque never moves
+// its elements on push_back, so prev_ pointers and the &out captures in backward_
+// stay valid until the graph is released with Graph::clear() after backward().
+class Graph {
+public:
+  static Value& node(double data, std::vector<Value*> prev, std::string op) {
+    nodes().emplace_back(data, std::move(prev), [](){}, std::move(op));
+    peak_size() = std::max(peak_size(), nodes().size());
+    return nodes().back();
+  }
+
+  static void clear() { nodes().clear(); }
+  static size_t size() { return nodes().size(); }
+
+  // Largest number of live nodes since the last reset_peak()
+  static size_t peak() { return peak_size(); }
+  static void reset_peak() { peak_size() = nodes().size(); }
+
+private:
+  static std::deque<Value>& nodes() {
+    static std::deque<Value> nodes;
+    return nodes;
+  }
+  static size_t& peak_size() {
+    static size_t peak = 0;
+    return peak;
+  }
+};
+
+inline Value& operator+(Value& a, Value& b) {
+  Value& out = Graph::node(a.data + b.data, {&a, &b}, "+");
+  out.backward_ = [&a, &b, &out]() {
+    a.grad += out.grad;
+    b.grad += out.grad;
+  };
   return out;
 }
 
-inline Value operator+(Value& a, double b) {
-  Value out(a.data + b, {&a}, [&a, &out]() {
+inline Value& operator+(Value& a, double b) {
+  Value& out = Graph::node(a.data + b, {&a}, "+");
+  out.backward_ = [&a, &out]() {
     a.grad += 1 * out.grad;
-  }, "+");
+  };
   return out;
 }
 
-inline Value operator+(double a, Value& b) {
-  Value out(a + b.data, {&b}, [&b, &out]() {
+inline Value& operator+(double a, Value& b) {
+  Value& out = Graph::node(a + b.data, {&b}, "+");
+  out.backward_ = [&b, &out]() {
     b.grad += 1 * out.grad;
-  }, "+");
+  };
   return out;
 }
 
-inline Value operator*(Value& a, Value& b) {
-  Value out(
-      a.data * b.data,
-      {&a, &b},
-      [&a, &b, &out]() {
-        a.grad += out.grad * b.data;
-        b.grad += out.grad * a.data;
-      },
-      "*");
+inline Value& operator*(Value& a, Value& b) {
+  Value& out = Graph::node(a.data * b.data, {&a, &b}, "*");
+  out.backward_ = [&a, &b, &out]() {
+    a.grad += out.grad * b.data;
+    b.grad += out.grad * a.data;
+  };
   return out;
 }
 
-inline Value operator*(Value& a, double b) {
-  Value out(a.data * b, {&a}, [&a, b, &out]() {
+inline Value& operator*(Value& a, double b) {
+  Value& out = Graph::node(a.data * b, {&a}, "*");
+  out.backward_ = [&a, b, &out]() {
     a.grad += b * out.grad;
-  }, "*");
+  };
   return out;
 }
 
-inline Value operator*(double a, Value& b) {
-  Value out(a * b.data, {&b}, [a, &b, &out]() {
+inline Value& operator*(double a, Value& b) {
+  Value& out = Graph::node(a * b.data, {&b}, "*");
+  out.backward_ = [a, &b, &out]() {
     b.grad += a * out.grad;
-  }, "*");
+  };
   return out;
 }
 
-inline Value operator-(Value& a, Value& b) {
-  Value out(
-    a.data - b.data,
-    {&a, &b},
-    [&a, &b, &out]() {
-      a.grad += out.grad;
-      b.grad -= out.grad;
-    },
-    "-");
+inline Value& operator-(Value& a, Value& b) {
+  Value& out = Graph::node(a.data - b.data, {&a, &b}, "-");
+  out.backward_ = [&a, &b, &out]() {
+    a.grad += out.grad;
+    b.grad -= out.grad;
+  };
   return out;
 }
 
-inline Value operator-(Value& a, double b_const) {
-    Value out(a.data - b_const, {&a}, 
-              [&a, &out]() {
-                a.grad += out.grad; // d(out)/da = 1
-              }, "-");
+inline Value& operator-(Value& a, double b_const) {
+    Value& out = Graph::node(a.data - b_const, {&a}, "-");
+    out.backward_ = [&a, &out]() {
+        a.grad += out.grad; // d(out)/da = 1
+    };
     return out;
 }
 
-inline Value operator-(double a_const, Value& b) {
-    Value out(a_const - b.data, {&b}, 
-              [&b, &out]() {
-                b.grad -= out.grad; // d(out)/db = -1
-              }, "-");
+inline Value& operator-(double a_const, Value& b) {
+    Value& out = Graph::node(a_const - b.data, {&b}, "-");
+    out.backward_ = [&b, &out]() {
+        b.grad -= out.grad; // d(out)/db = -1
+    };
     return out;
 }
 
-inline Value operator/(Value& a, Value& b) {
+inline Value& operator/(Value& a, Value& b) {
     // Ensure b.data is not zero to prevent division by zero.
     // A more robust implementation might throw an exception or handle this case differently.
     if (b.data == 0) {
         // Handle division by zero, e.g., by returning a Value with NaN or infinity,
         // and possibly setting a very large gradient for b.
         // For simplicity, this example doesn't fully handle it but it's critical in a real scenario.
-        return Value(std::numeric_limits<double>::quiet_NaN(), {&a, &b}, [](){}, "/");
+        return Graph::node(std::numeric_limits<double>::quiet_NaN(), {&a, &b}, "/");
     }
-    Value out(
-        a.data / b.data,
-        {&a, &b},
-        [&a, &b, &out]() {
-            a.grad += out.grad / b.data;
-            b.grad += out.grad * (-a.data / (b.data * b.data));
-        },
-        "/");
+    Value& out = Graph::node(a.data / b.data, {&a, &b}, "/");
+    out.backward_ = [&a, &b, &out]() {
+        a.grad += out.grad / b.data;
+        b.grad += out.grad * (-a.data / (b.data * b.data));
+    };
     return out;
 }
 
-inline Value operator/(Value& a, double b) {
+inline Value& operator/(Value& a, double b) {
     if (b == 0) {
-        return Value(std::numeric_limits<double>::quiet_NaN(), {&a}, [](){}, "/");
+        return Graph::node(std::numeric_limits<double>::quiet_NaN(), {&a}, "/");
     }
-    Value out(a.data / b, {&a}, [&a, b, &out]() {
+    Value& out = Graph::node(a.data / b, {&a}, "/");
+    out.backward_ = [&a, b, &out]() {
         a.grad += (1 / b) * out.grad;
-    }, "/");
+    };
     return out;
 }
 
-inline Value operator/(double a, Value& b) {
+inline Value& operator/(double a, Value& b) {
     if (b.data == 0) {
-        return Value(std::numeric_limits<double>::quiet_NaN(), {&b}, [](){}, "/");
+        return Graph::node(std::numeric_limits<double>::quiet_NaN(), {&b}, "/");
     }
-    Value out(a / b.data, {&b}, [a, &b, &out]() {
+    Value& out = Graph::node(a / b.data, {&b}, "/");
+    out.backward_ = [a, &b, &out]() {
         b.grad += (-a / (b.data * b.data)) * out.grad;
-    }, "/");
+    };
     return out;
 }
 
@@ -173,120 +206,101 @@ inline bool operator<(const Value& a, const Value& b) {
   return a.data < b.data;
 }
 
-Value ReLU(Value& x) {
+Value& ReLU(Value& x) {
   double output = x.data > 0 ? x.data : 0;
-  Value out(
-      output,
-      {&x},
-      [&x, &out]() {
-        x.grad += (x.data > 0 ? 1.0 : 0.0) * out.grad;
-      },
-      "ReLU");
+  Value& out = Graph::node(output, {&x}, "ReLU");
+  out.backward_ = [&x, &out]() {
+    x.grad += (x.data > 0 ? 1.0 : 0.0) * out.grad;
+  };
   return out;
 }
 
-Value tanh(Value& x) {
+Value& tanh(Value& x) {
   double output = (std::exp(2 * x.data) - 1) / (std::exp(2 * x.data) + 1);
-  Value out(
-      output,
-      {&x},
-      [&x, &out]() {
-        x.grad += (1 - out.data * out.data) * out.grad;
-      },
-      "tanh");
+  Value& out = Graph::node(output, {&x}, "tanh");
+  out.backward_ = [&x, &out]() {
+    x.grad += (1 - out.data * out.data) * out.grad;
+  };
   return out;
 }
 
-Value exp(Value& a) {
+Value& exp(Value& a) {
     double val = std::exp(a.data);
-    Value out(
-        val,
-        {&a},
-        [&a, val, &out]() { 
-            a.grad += val * out.grad; 
-        },
-        "exp");
+    Value& out = Graph::node(val, {&a}, "exp");
+    out.backward_ = [&a, val, &out]() {
+        a.grad += val * out.grad;
+    };
     return out;
 }
 
-Value log(Value& a) {
+Value& log(Value& a) {
     // Ensure a.data is positive for log
     if (a.data <= 0) {
         // Handle log of non-positive number
-        return Value(std::numeric_limits<double>::quiet_NaN(), {&a}, [](){}, "log");
+        return Graph::node(std::numeric_limits<double>::quiet_NaN(), {&a}, "log");
     }
-    Value out(
-        std::log(a.data),
-        {&a},
-        [&a, &out]() {
-            a.grad += (1 / a.data) * out.grad;
-        },
-        "log");
+    Value& out = Graph::node(std::log(a.data), {&a}, "log");
+    out.backward_ = [&a, &out]() {
+        a.grad += (1 / a.data) * out.grad;
+    };
     return out;
 }
 
-Value pow(Value& a, double p) {
-    Value out(
-        std::pow(a.data, p),
-        {&a},
-        [&a, p, &out]() {
-            a.grad += (p * std::pow(a.data, p - 1)) * out.grad;
-        },
-        "pow");
+Value& pow(Value& a, double p) {
+    Value& out = Graph::node(std::pow(a.data, p), {&a}, "pow");
+    out.backward_ = [&a, p, &out]() {
+        a.grad += (p * std::pow(a.data, p - 1)) * out.grad;
+    };
     return out;
 }
 
 // Loss Functions
-Value MSE(Value& y, Value& y_hat) {
-  Value diff = y - y_hat;
-  Value out = diff * diff; // Using overloaded operators
+Value& MSE(Value& y, Value& y_hat) {
+  Value& diff = y - y_hat;
+  Value& out = diff * diff; // Using overloaded operators
   out.op_ = "MSE";
 
   return out;
 }
 
 // Softmax and Cross-Entropy Loss for multi-class classification
-std::vector<Value> softmax(std::vector<Value>& logits) {
-    std::vector<Value> exps;
+std::vector<Value*> softmax(std::vector<Value*>& logits) {
+    std::vector<Value*> exps;
     exps.reserve(logits.size());
-    double max_logit_val = logits[0].data;
+    double max_logit_val = logits[0]->data;
     for (size_t i = 1; i < logits.size(); ++i) {
-        if (logits[i].data > max_logit_val) {
-            max_logit_val = logits[i].data;
+        if (logits[i]->data > max_logit_val) {
+            max_logit_val = logits[i]->data;
         }
     }
 
-    Value sum_exp_val = Value(0.0, {}, [](){}, "");
-    for (auto& logit : logits) {
-        // Create a temporary Value for (logit - max_logit_val)
-        Value adjusted_logit = logit - max_logit_val;
-        Value exp_val = exp(adjusted_logit);
-        exps.push_back(exp_val);
-        sum_exp_val = sum_exp_val + exp_val;
+    Value* sum_exp_val = &Graph::node(0.0, {}, "");
+    for (Value* logit : logits) {
+        // Shift by the max logit for numerical stability
+        Value& adjusted_logit = *logit - max_logit_val;
+        Value& exp_val = exp(adjusted_logit);
+        exps.push_back(&exp_val);
+        sum_exp_val = &(*sum_exp_val + exp_val);
     }
 
-    std::vector<Value> probs;
+    std::vector<Value*> probs;
     probs.reserve(logits.size());
-    for (auto& exp_val : exps) {
-        probs.push_back(exp_val / sum_exp_val);
+    for (Value* exp_val : exps) {
+        probs.push_back(&(*exp_val / *sum_exp_val));
     }
     return probs;
 }
 
-Value cross_entropy_loss(std::vector<Value>& probs, int target_index) {
+Value& cross_entropy_loss(std::vector<Value*>& probs, int target_index) {
     // Ensure target_index is valid
     if (target_index < 0 || static_cast<size_t>(target_index) >= probs.size()) {
-        return Value(0, {}, [](){}, "error_cross_entropy_invalid_index");
-    }
-    
-    Value prob_target = probs[static_cast<size_t>(target_index)];
-    double epsilon = 1e-12; 
-    if (prob_target.data < epsilon) { 
+        return Graph::node(0, {}, "error_cross_entropy_invalid_index");
     }
 
-    Value log_prob = log(prob_target);
-    Value neg_one = Value(-1.0, {}, [](){}, "const_neg_one");
-    Value loss = neg_one * log_prob;
+    Value& prob_target = *probs[static_cast<size_t>(target_index)];
+    Value& log_prob = log(prob_target);
+    Value& neg_one = Graph::node(-1.0, {}, "const_neg_one");
+    Value& loss = neg_one * log_prob;
     loss.op_ = "cross_entropy";
     return loss;
-}
\ No newline at end of file
+}
@@ -3,6 +3,9 @@
 #include "./engine.hpp"
 #include <random>
 #include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
 
 class Module {
 public:
@@ -14,7 +17,7 @@ public:
 class Neuron : public Module {
 public:
   // Neuron constructor
-  Neuron(std::size_t nin, bool nonlin = true, Value bias = Value(0, {}, [](){}, "")) : weights_(nin), bias_(bias), nonlin_(nonlin) {
+  Neuron(std::size_t nin, bool nonlin = true, Value bias = Value(0, {}, [](){}, "")) : weights_(nin), bias_(std::move(bias)), nonlin_(nonlin) {
     // Xavier/Glorot initialization
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -25,19 +28,25 @@ public:
     }
   }
 
-  // Forward pass
-  Value forward_pass(const std::vector<Value>& inputs) {
-    inputs_ = inputs;
-    Value act = Value(0, {}, [](){}, "act");
-    for (std::size_t i = 0; i < weights_.size(); i++) {
-      Value temp = (weights_[i] * inputs_[i]);
-      act = act + temp;
+  // Forward pass: dense dot product, or sparse-dense over the surviving weights only
+  Value& forward_pass(const std::vector<Value*>& inputs) {
+    Value* act = &Graph::node(0, {}, "act");
+    if (dense()) {
+      for (std::size_t i = 0; i < weights_.size(); i++) {
+        Value& temp = (weights_[i] * *inputs[i]);
+        act = &(*act + temp);
+      }
+    } else {
+      for (std::size_t i = 0; i < weights_.size(); i++) {
+        Value& temp = (weights_[i] * *inputs[indices_[i]]);
+        act = &(*act + temp);
+      }
     }
-    act = act + bias_;
+    act = &(*act + bias_);
     if (nonlin_) {
-      return ReLU(act);
+      return ReLU(*act);
     }
-    return act;
+    return *act;
   }
 
   std::vector<Value*> parameters() override {
@@ -56,9 +65,82 @@ public:
     bias_.grad = 0;
   }
 
+  // Drop every weight whose keep flag is false. Once pruned, weights_/indices_
+  // form one CSR row: pruned weights are removed from storage entirely, so they
+  // never enter the graph or parameters() and stay zero through optimizer updates.
+  void prune(const std::vector<bool>& keep) {
+    if (std::find(keep.begin(), keep.end(), false) == keep.end()) return;
+    if (dense()) {
+      indices_.resize(weights_.size());
+      for (std::size_t i = 0; i < indices_.size(); i++) indices_[i] = i;
+    }
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < weights_.size(); i++) {
+      if (!keep[i]) continue;
+      if (n != i) {
+        weights_[n] = std::move(weights_[i]);
+        indices_[n] = indices_[i];
+      }
+      n++;
+    }
+    weights_.resize(n);
+    indices_.resize(n);
+    weights_.shrink_to_fit();
+    indices_.shrink_to_fit();
+  }
+
+  const std::vector<Value>& weights() const { return weights_; }
+  std::size_t nnz() const { return weights_.size(); }
+
+  // A neuron stays dense (no column indices) until its first weight is pruned
+  bool dense() const { return indices_.empty(); }
+
+  // Bytes held by the weight row: Values plus column indices once sparse
+  std::size_t weight_bytes() const {
+    return weights_.capacity() * sizeof(Value) + indices_.capacity() * sizeof(std::size_t);
+  }
+
+  // Binary (de)serialization of the CSR row and bias, used for checkpoints
+  void save(std::ostream& out) const {
+    uint64_t n = weights_.size();
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    for (std::size_t i = 0; i < weights_.size(); i++) {
+      uint64_t idx = dense() ? i : indices_[i];
+      out.write(reinterpret_cast<const char*>(&idx), sizeof(idx));
+      out.write(reinterpret_cast<const char*>(&weights_[i].data), sizeof(double));
+    }
+    out.write(reinterpret_cast<const char*>(&bias_.data), sizeof(double));
+  }
+
+  // Rejects rows that don't fit `nin` inputs: more than nin weights, or column
+  // indices that are out of range or not strictly increasing.
+  bool load(std::istream& in, std::size_t nin) {
+    uint64_t n = 0;
+    if (!in.read(reinterpret_cast<char*>(&n), sizeof(n)) || n > nin) return false;
+    std::vector<Value> weights(n);
+    std::vector<std::size_t> indices(n);
+    for (uint64_t i = 0; i < n; i++) {
+      uint64_t idx = 0;
+      double w = 0;
+      in.read(reinterpret_cast<char*>(&idx), sizeof(idx));
+      in.read(reinterpret_cast<char*>(&w), sizeof(w));
+      if (!in || idx >= nin || (i > 0 && idx <= indices[i - 1])) return false;
+      indices[i] = idx;
+      weights[i] = Value(w, {}, [](){}, "weight");
+    }
+    double b = 0;
+    if (!in.read(reinterpret_cast<char*>(&b), sizeof(b))) return false;
+    // A full row of strictly increasing indices is exactly 0..nin-1: keep it dense
+    if (n == nin) indices = std::vector<std::size_t>();
+    weights_ = std::move(weights);
+    indices_ = std::move(indices);
+    bias_.data = b;
+    return true;
+  }
+
 private:
   std::vector<Value> weights_;
-  std::vector<Value> inputs_;
+  std::vector<std::size_t> indices_; // Column (input) index of each stored weight; empty while dense
   Value bias_;
   bool nonlin_; 
 };
@@ -75,11 +157,11 @@ public:
   }
 
   // Forward pass
-  std::vector<Value> forward_pass(const std::vector<Value>& inputs) {
-    std::vector<Value> outputs;
+  std::vector<Value*> forward_pass(const std::vector<Value*>& inputs) {
+    std::vector<Value*> outputs;
     outputs.reserve(neurons_.size());
     for (auto& neuron : neurons_) {
-      outputs.push_back(neuron.forward_pass(inputs));
+      outputs.push_back(&neuron.forward_pass(inputs));
     }
     return outputs;
   }
@@ -99,6 +181,78 @@ public:
     }
   }
 
+  // Magnitude pruning: remove the smallest-|w| weights across the whole layer
+  // until `sparsity` of the dense nin x num_neurons matrix is zero. Sparsity
+  // only ever grows, so calling this with a rising schedule prunes iteratively.
+  // Returns false (and leaves the layer untouched) unless 0 <= sparsity <= 1.
+  bool prune(double sparsity) {
+    if (!(sparsity >= 0.0 && sparsity <= 1.0)) {
+      std::cerr << "Invalid sparsity " << sparsity << ": must be in [0, 1]" << std::endl;
+      return false;
+    }
+    size_t dense = dense_size();
+    size_t target_pruned = static_cast<size_t>(sparsity * dense);
+    size_t already_pruned = dense - nnz();
+    if (target_pruned <= already_pruned) return true;
+    size_t to_prune = target_pruned - already_pruned;
+
+    // (|w|, neuron, position) for every weight still stored
+    std::vector<std::pair<double, std::pair<size_t, size_t>>> mags;
+    mags.reserve(nnz());
+    for (size_t n = 0; n < neurons_.size(); n++) {
+      const auto& w = neurons_[n].weights();
+      for (size_t i = 0; i < w.size(); i++) {
+        mags.push_back({std::fabs(w[i].data), {n, i}});
+      }
+    }
+    std::nth_element(mags.begin(), mags.begin() + to_prune, mags.end());
+
+    std::vector<std::vector<bool>> keep(neurons_.size());
+    for (size_t n = 0; n < neurons_.size(); n++) {
+      keep[n].assign(neurons_[n].nnz(), true);
+    }
+    for (size_t k = 0; k < to_prune; k++) {
+      keep[mags[k].second.first][mags[k].second.second] = false;
+    }
+    for (size_t n = 0; n < neurons_.size(); n++) {
+      neurons_[n].prune(keep[n]);
+    }
+    return true;
+  }
+
+  size_t nnz() const {
+    size_t total = 0;
+    for (const auto& neuron : neurons_) total += neuron.nnz();
+    return total;
+  }
+
+  size_t weight_bytes() const {
+    size_t total = 0;
+    for (const auto& neuron : neurons_) total += neuron.weight_bytes();
+    return total;
+  }
+
+  // Number of weights in the dense nin x num_neurons matrix
+  size_t dense_size() const { return nin_ * neurons_.size(); }
+
+  double sparsity() const {
+    return 1.0 - static_cast<double>(nnz()) / dense_size();
+  }
+
+  void save(std::ostream& out) const {
+    for (const auto& neuron : neurons_) neuron.save(out);
+  }
+
+  bool load(std::istream& in) {
+    for (auto& neuron : neurons_) {
+      if (!neuron.load(in, nin_)) return false;
+    }
+    return true;
+  }
+
+  size_t nin() const { return nin_; }
+  size_t num_neurons() const { return neurons_.size(); }
+
 private:
   std::vector<Neuron> neurons_;
   size_t nin_;
@@ -117,8 +271,8 @@ public:
   }
 
   // Forward pass
-  std::vector<Value> forward_pass(const std::vector<Value>& inputs) {
-    std::vector<Value> outputs = inputs;
+  std::vector<Value*> forward_pass(const std::vector<Value*>& inputs) {
+    std::vector<Value*> outputs = inputs;
     for (auto& layer : layers_) {
       outputs = layer.forward_pass(outputs);
     }
@@ -140,6 +294,55 @@ public:
     }
   }
 
+  // Prune each layer to its own target sparsity (exactly one entry per layer).
+  // All targets are validated before any layer is pruned.
+  bool prune(const std::vector<double>& sparsities) {
+    if (sparsities.size() != layers_.size()) {
+      std::cerr << "Expected " << layers_.size() << " sparsity values, got " << sparsities.size() << std::endl;
+      return false;
+    }
+    for (double sparsity : sparsities) {
+      if (!(sparsity >= 0.0 && sparsity <= 1.0)) {
+        std::cerr << "Invalid sparsity " << sparsity << ": must be in [0, 1]" << std::endl;
+        return false;
+      }
+    }
+    for (size_t i = 0; i < layers_.size(); i++) {
+      layers_[i].prune(sparsities[i]);
+    }
+    return true;
+  }
+
+  size_t num_layers() const { return layers_.size(); }
+
+  const std::vector<Layer>& layers() const { return layers_; }
+
+  // Layout: layer count, (nin, num_neurons) per layer, then every layer's rows.
+  // load() checks the shape against this network before touching any weight.
+  void save(std::ostream& out) const {
+    uint64_t num = layers_.size();
+    out.write(reinterpret_cast<const char*>(&num), sizeof(num));
+    for (const auto& layer : layers_) {
+      uint64_t shape[2] = {layer.nin(), layer.num_neurons()};
+      out.write(reinterpret_cast<const char*>(shape), sizeof(shape));
+    }
+    for (const auto& layer : layers_) layer.save(out);
+  }
+
+  bool load(std::istream& in) {
+    uint64_t num = 0;
+    if (!in.read(reinterpret_cast<char*>(&num), sizeof(num)) || num != layers_.size()) return false;
+    for (const auto& layer : layers_) {
+      uint64_t shape[2] = {0, 0};
+      if (!in.read(reinterpret_cast<char*>(shape), sizeof(shape))) return false;
+      if (shape[0] != layer.nin() || shape[1] != layer.num_neurons()) return false;
+    }
+    for (auto& layer : layers_) {
+      if (!layer.load(in)) return false;
+    }
+    return true;
+  }
+
 private:
   std::vector<Layer> layers_;
 };
\ No newline at end of file
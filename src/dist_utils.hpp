@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream> // For error reporting
+
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+
+#include <fcntl.h>       // For O_CREAT, O_RDWR
+#include <pthread.h>     // For the process-shared mutex/condvar barrier
+#include <sys/mman.h>    // For shm_open, mmap
+#include <sys/prctl.h>   // For PR_SET_PDEATHSIG
+#include <sys/wait.h>    // For waitpid
+#include <unistd.h>      // For ftruncate, getpid, fork
+
+// IEEE 754 binary32 -> binary16, round to nearest even
+uint16_t float_to_half(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    int32_t exponent = static_cast<int32_t>((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = x & 0x7fffff;
+
+    if (((x >> 23) & 0xff) == 0xff) { // Inf / NaN
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31) { // Overflow to infinity
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    if (exponent <= 0) { // Subnormal or zero
+        if (exponent < -10) return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half_mantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) half_mantissa++;
+        return static_cast<uint16_t>(sign | half_mantissa);
+    }
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) half++; // May carry into the exponent, which is correct
+    return static_cast<uint16_t>(half);
+}
+
+// IEEE 754 binary16 -> binary32
+float half_to_float(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t x;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            x = sign;
+        } else { // Normalize the subnormal
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            x = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    } else if (exponent == 31) {
+        x = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        x = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// Control block at the start of the shared segment. The barrier is a
+// process-shared mutex/condvar pair rather than pthread_barrier_t so waiters can
+// time out, notice a dead peer and abort instead of blocking forever.
+struct ShmHeader {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int arrived;          // Ranks waiting in the current barrier generation
+    unsigned generation;  // Bumped each time the barrier opens
+    int abort;            // Set by whichever rank first detects a failure
+    int world_size;
+    size_t max_chunk; // Elements per rank per outbox bank
+};
+
+// N cooperating processes sharing one POSIX shared-memory segment.
+// The segment is created by rank 0 before fork(), so every worker inherits the
+// mapping; the name is unlinked right away and the memory goes away with the last process.
+//
+// Layout: [ShmHeader][outbox bank 0: world_size * max_chunk][outbox bank 1: ...]
+//         [scalar bank 0: world_size doubles][scalar bank 1: ...]
+// Each rank only writes its own outbox/scalar slot; two banks alternate between
+// steps so a single barrier per step is enough.
+//
+// Failure handling: rank 0 reaps its workers with waitpid(WNOHANG) while it waits,
+// workers watch getppid(); either side raises the shared abort flag, and every
+// barrier()/all_reduce() then returns false so all ranks can exit with an error.
+struct ShmWorld {
+    int rank = 0;
+    int world_size = 1;
+    bool fp16 = false;
+
+    bool create(int num_procs, size_t num_params, bool use_fp16) {
+        world_size = num_procs;
+        fp16 = use_fp16;
+        size_t max_chunk = (num_params + world_size - 1) / world_size;
+        size_t elem_size = fp16 ? sizeof(uint16_t) : sizeof(float);
+        size_ = sizeof(ShmHeader) + 2 * world_size * max_chunk * elem_size + 2 * world_size * sizeof(double);
+
+        std::string name = "/tiny_mlp_" + std::to_string(getpid());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            std::cerr << "shm_open failed for " << name << std::endl;
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+            std::cerr << "ftruncate failed for " << name << std::endl;
+            close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        base_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        shm_unlink(name.c_str());
+        if (base_ == MAP_FAILED) {
+            std::cerr << "mmap failed for " << name << std::endl;
+            base_ = nullptr;
+            return false;
+        }
+
+        header_ = static_cast<ShmHeader*>(base_);
+        header_->arrived = 0;
+        header_->generation = 0;
+        header_->abort = 0;
+        header_->world_size = world_size;
+        header_->max_chunk = max_chunk;
+
+        pthread_mutexattr_t mutex_attr;
+        pthread_mutexattr_init(&mutex_attr);
+        pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST); // Survive a holder dying
+        pthread_mutex_init(&header_->mutex, &mutex_attr);
+        pthread_mutexattr_destroy(&mutex_attr);
+
+        pthread_condattr_t cond_attr;
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&header_->cond, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+        return true;
+    }
+
+    // Fork ranks 1..world_size-1. Returns false in rank 0 if a fork failed
+    // (the workers already started are aborted); workers never see false.
+    bool spawn() {
+        pid_t parent = getpid();
+        for (int r = 1; r < world_size; ++r) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "fork failed for rank " << r << std::endl;
+                abort_all();
+                join();
+                return false;
+            }
+            if (pid == 0) {
+                // Don't outlive rank 0; if it already exited before prctl ran, the
+                // signal will never come, so check the parent explicitly.
+                prctl(PR_SET_PDEATHSIG, SIGTERM);
+                if (getppid() != parent) _exit(1);
+                rank = r;
+                parent_ = parent;
+                children_.clear();
+                return true;
+            }
+            children_.push_back(pid);
+        }
+        return true;
+    }
+
+    // Rank 0: wait for every worker. Returns false if any exited abnormally.
+    bool join() {
+        bool ok = true;
+        for (pid_t pid : children_) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+            std::cerr << "Worker process " << pid << " exited abnormally." << std::endl;
+            ok = false;
+        }
+        children_.clear();
+        return ok;
+    }
+
+    // Raise the shared abort flag and wake every waiter; rank 0 also stops its workers
+    void abort_all() {
+        if (header_) {
+            lock();
+            header_->abort = 1;
+            pthread_cond_broadcast(&header_->cond);
+            pthread_mutex_unlock(&header_->mutex);
+        }
+        for (pid_t pid : children_) kill(pid, SIGTERM);
+    }
+
+    bool aborted() const { return header_ && header_->abort; }
+
+    // Returns false if the run was aborted (a peer died) instead of blocking forever
+    bool barrier() {
+        if (world_size <= 1) return true;
+        lock();
+        if (header_->abort) {
+            pthread_mutex_unlock(&header_->mutex);
+            return false;
+        }
+        unsigned generation = header_->generation;
+        if (++header_->arrived == world_size) {
+            header_->arrived = 0;
+            header_->generation++;
+            pthread_cond_broadcast(&header_->cond);
+            pthread_mutex_unlock(&header_->mutex);
+            return true;
+        }
+        while (header_->generation == generation && !header_->abort) {
+            timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += 1; // Liveness check interval
+            int rc = pthread_cond_timedwait(&header_->cond, &header_->mutex, &deadline);
+            if (rc == EOWNERDEAD) {
+                pthread_mutex_consistent(&header_->mutex);
+                header_->abort = 1;
+            } else if (rc == ETIMEDOUT && !peers_alive()) {
+                header_->abort = 1;
+                pthread_cond_broadcast(&header_->cond);
+            }
+        }
+        bool ok = (header_->generation != generation);
+        pthread_mutex_unlock(&header_->mutex);
+        return ok;
+    }
+
+    // Ring all-reduce (sum) of `data` across all ranks: N-1 reduce-scatter steps
+    // followed by N-1 all-gather steps, each moving one chunk to the next rank.
+    // Chunks travel as float, or as half precision with fp16 enabled; each rank
+    // rounds its owned chunk the same way so every replica ends with identical values.
+    // Returns false if the run was aborted or `data` is larger than the
+    // num_params the segment was created for.
+    bool all_reduce(std::vector<double>& data) {
+        if (world_size <= 1) return true;
+        if (data.size() > world_size * header_->max_chunk) {
+            std::cerr << "all_reduce: " << data.size() << " elements exceed the shared segment capacity of "
+                      << world_size * header_->max_chunk << std::endl;
+            return false;
+        }
+        size_t chunk = (data.size() + world_size - 1) / world_size;
+        int prev = (rank - 1 + world_size) % world_size;
+
+        for (int s = 0; s < world_size - 1; ++s) {
+            send_chunk(data, (rank - s + world_size) % world_size, chunk);
+            if (!barrier()) return false;
+            recv_chunk(data, (prev - s + world_size) % world_size, prev, chunk, true);
+            step_++;
+        }
+
+        size_t begin, end;
+        chunk_range((rank + 1) % world_size, chunk, data.size(), begin, end);
+        for (size_t i = begin; i < end; ++i) {
+            float f = static_cast<float>(data[i]);
+            data[i] = fp16 ? half_to_float(float_to_half(f)) : f;
+        }
+
+        for (int s = 0; s < world_size - 1; ++s) {
+            send_chunk(data, (rank + 1 - s + world_size) % world_size, chunk);
+            if (!barrier()) return false;
+            recv_chunk(data, (rank - s + world_size) % world_size, prev, chunk, false);
+            step_++;
+        }
+        return true;
+    }
+
+    // Sum one scalar across ranks at full double precision (never fp16), e.g. the
+    // batch loss. Every rank adds the slots in rank order, so all get the same value.
+    bool all_reduce_scalar(double& value) {
+        if (world_size <= 1) return true;
+        scalar_slots()[rank] = value;
+        if (!barrier()) return false;
+        const double* slots = scalar_slots();
+        double sum = 0.0;
+        for (int r = 0; r < world_size; ++r) sum += slots[r];
+        value = sum;
+        step_++;
+        return true;
+    }
+
+    void destroy() {
+        if (!base_) return;
+        // After an abort a dead rank may still count as a condvar waiter, and
+        // pthread_cond_destroy would wait for it forever; the unmap frees it anyway
+        if (rank == 0 && !header_->abort) {
+            pthread_cond_destroy(&header_->cond);
+            pthread_mutex_destroy(&header_->mutex);
+        }
+        munmap(base_, size_);
+        base_ = nullptr;
+        header_ = nullptr;
+    }
+
+private:
+    void* base_ = nullptr;
+    ShmHeader* header_ = nullptr;
+    size_t size_ = 0;
+    size_t step_ = 0; // Selects the outbox bank; persists across calls
+    pid_t parent_ = 0;             // Workers: pid of rank 0
+    std::vector<pid_t> children_;  // Rank 0: worker pids
+
+    void lock() {
+        if (pthread_mutex_lock(&header_->mutex) == EOWNERDEAD) {
+            // A rank died inside the critical section; the barrier state is suspect
+            pthread_mutex_consistent(&header_->mutex);
+            header_->abort = 1;
+            pthread_cond_broadcast(&header_->cond);
+        }
+    }
+
+    // Rank 0 checks its workers, workers check that rank 0 is still their parent
+    bool peers_alive() {
+        if (rank != 0) return getppid() == parent_;
+        for (pid_t pid : children_) {
+            int status = 0;
+            if (waitpid(pid, &status, WNOHANG) != 0) {
+                std::cerr << "Worker process " << pid << " died; aborting all ranks." << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void chunk_range(int c, size_t chunk, size_t n, size_t& begin, size_t& end) const {
+        begin = std::min(n, c * chunk);
+        end = std::min(n, begin + chunk);
+    }
+
+    char* outbox(int r) const {
+        size_t elem_size = fp16 ? sizeof(uint16_t) : sizeof(float);
+        size_t bank = step_ % 2;
+        return static_cast<char*>(base_) + sizeof(ShmHeader)
+            + (bank * world_size + r) * header_->max_chunk * elem_size;
+    }
+
+    double* scalar_slots() const {
+        size_t elem_size = fp16 ? sizeof(uint16_t) : sizeof(float);
+        char* scalars = static_cast<char*>(base_) + sizeof(ShmHeader) + 2 * world_size * header_->max_chunk * elem_size;
+        return reinterpret_cast<double*>(scalars) + (step_ % 2) * world_size;
+    }
+
+    void send_chunk(const std::vector<double>& data, int c, size_t chunk) {
+        size_t begin, end;
+        chunk_range(c, chunk, data.size(), begin, end);
+        char* out = outbox(rank);
+        for (size_t i = begin; i < end; ++i) {
+            if (fp16) {
+                reinterpret_cast<uint16_t*>(out)[i - begin] = float_to_half(static_cast<float>(data[i]));
+            } else {
+                reinterpret_cast<float*>(out)[i - begin] = static_cast<float>(data[i]);
+            }
+        }
+    }
+
+    void recv_chunk(std::vector<double>& data, int c, int from, size_t chunk, bool accumulate) {
+        size_t begin, end;
+        chunk_range(c, chunk, data.size(), begin, end);
+        const char* in = outbox(from);
+        for (size_t i = begin; i < end; ++i) {
+            double v = fp16 ? half_to_float(reinterpret_cast<const uint16_t*>(in)[i - begin])
+                            : reinterpret_cast<const float*>(in)[i - begin];
+            data[i] = accumulate ? data[i] + v : v;
+        }
+    }
+};
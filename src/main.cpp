@@ -2,29 +2,282 @@
 #include <vector>
 #include <algorithm> // For std::max_element
 #include <iomanip>   // For std::fixed and std::setprecision
+#include <chrono>    // For per-epoch timing
+#include <cstring>   // For std::strcmp
+#include <cstdlib>   // For std::strtol, std::strtod
+#include <cstdio>    // For std::rename
+#include <fstream>   // For checkpoints
+#include <cerrno>    // For errno
 
 #include "../header/engine.hpp"
 #include "../header/nn.hpp"
 #include "./mnist_utils.hpp" // Include the MNIST utilities
+#include "./dist_utils.hpp"  // Shared-memory multi-process training
 
-// Prediction function
-int predict(MLP& network, const std::vector<Value>& input_image) {
-    std::vector<Value> logits = network.forward_pass(input_image);
-    std::vector<Value> probabilities = softmax(logits); // Assumes softmax is in engine.hpp scope
+// Convert a flat image to input leaves in the node arena
+std::vector<Value*> image_inputs(const std::vector<double>& image) {
+    std::vector<Value*> inputs;
+    inputs.reserve(image.size());
+    for (double pixel : image) {
+        inputs.push_back(&Graph::node(pixel, {}, "input_pixel"));
+    }
+    return inputs;
+}
+
+// Prediction function (releases the graph it builds)
+int predict(MLP& network, const std::vector<double>& image) {
+    std::vector<Value*> inputs = image_inputs(image);
+    std::vector<Value*> logits = network.forward_pass(inputs);
+    std::vector<Value*> probabilities = softmax(logits); // Assumes softmax is in engine.hpp scope
 
     // Find the index of the max probability
-    auto max_it = std::max_element(probabilities.begin(), probabilities.end(), 
-                                   [](const Value& a, const Value& b) {
-                                       return a.data < b.data;
+    auto max_it = std::max_element(probabilities.begin(), probabilities.end(),
+                                   [](const Value* a, const Value* b) {
+                                       return a->data < b->data;
                                    });
-    return std::distance(probabilities.begin(), max_it);
+    int label = static_cast<int>(std::distance(probabilities.begin(), max_it));
+    Graph::clear();
+    return label;
+}
+
+// Build one sample's graph (forward, softmax, cross-entropy) and return its loss.
+// The nodes stay in the arena until the caller runs backward() and Graph::clear().
+Value& sample_loss(MLP& network, const std::vector<double>& image, int target_label) {
+    std::vector<Value*> inputs = image_inputs(image);
+    std::vector<Value*> logits = network.forward_pass(inputs);
+    std::vector<Value*> probabilities = softmax(logits);
+    return cross_entropy_loss(probabilities, target_label);
+}
+
+// Add the gradient of the mean loss over samples [begin, begin + count) to the
+// parameter grads and return that mean loss.
+// The samples are processed in micro-batches of `micro_batch`: each one builds its
+// samples' graphs, runs backward on their summed loss / count and is released
+// before the next, so peak graph memory is bounded by the micro-batch size rather
+// than the batch size. micro_batch <= 0 builds one graph over the whole batch.
+double accumulate_batch_grads(MLP& network, const MNISTData& images, const std::vector<unsigned char>& labels,
+                              int begin, int count, int micro_batch) {
+    if (micro_batch <= 0) micro_batch = count;
+    double batch_loss = 0.0;
+    for (int m = 0; m < count; m += micro_batch) {
+        int micro_end = std::min(count, m + micro_batch);
+        Value* micro_batch_loss = &Graph::node(0.0, {}, "micro_batch_loss");
+        for (int j = m; j < micro_end; ++j) {
+            micro_batch_loss = &(*micro_batch_loss + sample_loss(network, images.images[begin + j], labels[begin + j]));
+        }
+
+        // Scale by the full batch size so the micro-batch gradients sum to the batch mean
+        Value& scaled_loss = *micro_batch_loss / static_cast<double>(count);
+        scaled_loss.backward();
+        batch_loss += scaled_loss.data;
+        Graph::clear();
+    }
+    return batch_loss;
+}
+
+// Check that micro-batch accumulation reproduces the whole-batch gradient
+// on the first `count` training samples. Leaves the parameter grads zeroed.
+bool check_grad_accumulation(MLP& network, const MNISTDataset& dataset, int count, int micro_batch) {
+    std::vector<Value*> params = network.parameters();
+
+    network.zero_grad();
+    accumulate_batch_grads(network, dataset.train_data, dataset.train_labels, 0, count, 0);
+    std::vector<double> monolithic(params.size());
+    for (size_t p = 0; p < params.size(); ++p) monolithic[p] = params[p]->grad;
+
+    network.zero_grad();
+    accumulate_batch_grads(network, dataset.train_data, dataset.train_labels, 0, count, micro_batch);
+    double max_abs_diff = 0.0;
+    double max_abs_grad = 0.0;
+    for (size_t p = 0; p < params.size(); ++p) {
+        max_abs_diff = std::max(max_abs_diff, std::fabs(params[p]->grad - monolithic[p]));
+        max_abs_grad = std::max(max_abs_grad, std::fabs(monolithic[p]));
+    }
+    network.zero_grad();
+
+    bool ok = max_abs_diff <= 1e-9 * std::max(1.0, max_abs_grad);
+    std::cout << "Gradient check over " << count << " samples (micro-batch " << micro_batch << " vs whole batch), "
+              << params.size() << " parameters: max |diff| "
+              << std::scientific << std::setprecision(3) << max_abs_diff << " (max |grad| " << max_abs_grad << ") "
+              << (ok ? "OK" : "MISMATCH") << std::defaultfloat << std::endl;
+    return ok;
+}
+
+// Gradual magnitude-pruning schedule: sparsity ramps from 0 to `final_sparsity`
+// with a cubic curve between start_epoch and end_epoch, so most weights are
+// removed early while the network can still recover.
+double scheduled_sparsity(double final_sparsity, int epoch, int start_epoch, int end_epoch) {
+    if (epoch < start_epoch) return 0.0;
+    if (epoch >= end_epoch) return final_sparsity;
+    double progress = static_cast<double>(epoch - start_epoch + 1) / (end_epoch - start_epoch + 1);
+    return final_sparsity * (1.0 - std::pow(1.0 - progress, 3));
+}
+
+// Print per-layer sparsity and the bytes held by stored weights
+void report_sparsity(const MLP& network) {
+    size_t total_nnz = 0;
+    const auto& layers = network.layers();
+    for (size_t l = 0; l < layers.size(); ++l) {
+        total_nnz += layers[l].nnz();
+        std::cout << "  Layer " << l << ": sparsity " << std::fixed << std::setprecision(4)
+                  << layers[l].sparsity() * 100.0 << "%, nnz " << layers[l].nnz() << std::endl;
+    }
+    // Held: what the rows actually store (pruned rows add a column index per weight).
+    // Dense: the same layers with every row unpruned, i.e. what the baseline run holds.
+    size_t total_dense = 0;
+    size_t held_bytes = 0;
+    for (const auto& layer : layers) {
+        total_dense += layer.dense_size();
+        held_bytes += layer.weight_bytes();
+    }
+    double held_mb = held_bytes / (1024.0 * 1024.0);
+    double dense_mb = total_dense * sizeof(Value) / (1024.0 * 1024.0);
+    std::cout << "  Stored weights: " << total_nnz << " / " << total_dense << " dense ("
+              << std::fixed << std::setprecision(2) << held_mb << " MB held vs " << dense_mb << " MB dense, "
+              << std::setprecision(1) << (dense_mb > 0 ? 100.0 * held_mb / dense_mb : 0.0) << "% of dense)" << std::endl;
+}
+
+// Parse a comma-separated list of per-layer sparsities, e.g. "0.9,0.9,0"
+bool parse_sparsities(const std::string& text, std::vector<double>& sparsities) {
+    sparsities.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        char* end = nullptr;
+        double value = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || !(value >= 0.0 && value <= 1.0)) return false;
+        sparsities.push_back(value);
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return true;
+}
+
+// Checkpoint layout: magic, next epoch, learning rate, then the network weights
+const uint32_t CHECKPOINT_MAGIC = 0x4d4c5031; // "MLP1"
+
+bool save_checkpoint(const std::string& path, const MLP& network, int next_epoch, double learning_rate) {
+    // Write to a temporary file and rename, so a crash never leaves a torn checkpoint
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open checkpoint file: " << tmp_path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&CHECKPOINT_MAGIC), sizeof(CHECKPOINT_MAGIC));
+    file.write(reinterpret_cast<const char*>(&next_epoch), sizeof(next_epoch));
+    file.write(reinterpret_cast<const char*>(&learning_rate), sizeof(learning_rate));
+    network.save(file);
+    file.close();
+    if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write checkpoint: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_checkpoint(const std::string& path, MLP& network, int& next_epoch, double& learning_rate) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open checkpoint file: " << path << std::endl;
+        return false;
+    }
+    uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if (magic != CHECKPOINT_MAGIC) {
+        std::cerr << "Invalid checkpoint file: Incorrect magic number in " << path << std::endl;
+        return false;
+    }
+    file.read(reinterpret_cast<char*>(&next_epoch), sizeof(next_epoch));
+    file.read(reinterpret_cast<char*>(&learning_rate), sizeof(learning_rate));
+    if (!file || next_epoch < 0 || !std::isfinite(learning_rate) || learning_rate <= 0.0) {
+        std::cerr << "Invalid checkpoint file: bad epoch or learning rate in " << path << std::endl;
+        return false;
+    }
+    if (!file || !network.load(file) || file.peek() != std::char_traits<char>::eof()) {
+        std::cerr << "Invalid checkpoint file: " << path << " is corrupt or does not match this network" << std::endl;
+        return false;
+    }
+    return true;
 }
 
 // Training function for a single batch/step (conceptual)
 // This will be integrated into the main training loop.
 // The core logic: zero_grad, forward, loss, backward, optimizer_step.
 
-int main() {
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--procs N] [--fp16] [--checkpoint PATH] [--resume] [--epochs N]"
+              << " [--micro-batch K | --no-grad-accum] [--check-grads] [--prune S1,S2,...]" << std::endl;
+}
+
+// Parse a whole-string integer in [min_value, max_value]
+bool parse_int(const char* text, int min_value, int max_value, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed < min_value || parsed > max_value) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// A collective failed (a peer died or the run was aborted): stop every rank and fail
+int abort_training(ShmWorld& world) {
+    std::cerr << "Rank " << world.rank << ": collective operation failed or a peer process died, aborting training." << std::endl;
+    world.abort_all();
+    if (world.rank == 0) world.join();
+    world.destroy();
+    return 1;
+}
+
+// Usage: mlp_mnist [--procs N] [--fp16] [--checkpoint PATH] [--resume] [--epochs N]
+//                  [--micro-batch K | --no-grad-accum] [--check-grads] [--prune S1,S2,...]
+int main(int argc, char** argv) {
+    // Backward per micro-batch of K samples into persistent parameter grads
+    // instead of one batch-wide graph; 0 = whole batch (--no-grad-accum)
+    int micro_batch = 1;
+    bool check_grads = false;
+
+    // Magnitude pruning: final sparsity per layer. Empty = dense baseline.
+    std::vector<double> prune_sparsity;
+
+    int epochs = 10;
+
+    // Multi-process options
+    int num_procs = 1;
+    bool use_fp16 = false;
+    std::string checkpoint_path;
+    bool resume = false;
+    for (int a = 1; a < argc; ++a) {
+        if (std::strcmp(argv[a], "--procs") == 0 && a + 1 < argc && parse_int(argv[a + 1], 1, 256, num_procs)) {
+            ++a;
+        } else if (std::strcmp(argv[a], "--epochs") == 0 && a + 1 < argc && parse_int(argv[a + 1], 1, 1000, epochs)) {
+            ++a;
+        } else if (std::strcmp(argv[a], "--fp16") == 0) {
+            use_fp16 = true;
+        } else if (std::strcmp(argv[a], "--checkpoint") == 0 && a + 1 < argc) {
+            checkpoint_path = argv[++a];
+        } else if (std::strcmp(argv[a], "--resume") == 0) {
+            resume = true;
+        } else if (std::strcmp(argv[a], "--micro-batch") == 0 && a + 1 < argc && parse_int(argv[a + 1], 1, 1000, micro_batch)) {
+            ++a;
+        } else if (std::strcmp(argv[a], "--no-grad-accum") == 0) {
+            micro_batch = 0;
+        } else if (std::strcmp(argv[a], "--check-grads") == 0) {
+            check_grads = true;
+        } else if (std::strcmp(argv[a], "--prune") == 0 && a + 1 < argc && parse_sparsities(argv[a + 1], prune_sparsity)) {
+            ++a;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (resume && checkpoint_path.empty()) {
+        std::cerr << "--resume requires --checkpoint PATH" << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+
     // MNIST specific parameters
     const int INPUT_SIZE = 28 * 28; // MNIST images are 28x28 pixels
     const int OUTPUT_SIZE = 10;     // 10 classes for digits 0-9
@@ -42,104 +295,175 @@ int main() {
     MLP network(architecture);
 
     // Training parameters
-    const int EPOCHS = 10;
+    const int EPOCHS = epochs;
     const int BATCH_SIZE = 32;
     double learning_rate = 0.001; // Reduced from 0.01 to 0.001
 
-    std::cout << "Starting training..." << std::endl;
+    // Pruning ramps up to --prune's targets between these epochs
+    if (!prune_sparsity.empty() && prune_sparsity.size() != network.num_layers()) {
+        std::cerr << "--prune needs one sparsity per layer (" << network.num_layers() << "), got "
+                  << prune_sparsity.size() << std::endl;
+        return 1;
+    }
+    // 0-based: the ramp starts in epoch 2 and reaches the targets in epoch 7. Short
+    // runs compress the ramp so the targets are still reached in the last epoch.
+    int PRUNE_START_EPOCH = 1;
+    int PRUNE_END_EPOCH = 6;
+    if (!prune_sparsity.empty() && EPOCHS <= PRUNE_END_EPOCH) {
+        PRUNE_END_EPOCH = EPOCHS - 1;
+        PRUNE_START_EPOCH = std::min(PRUNE_START_EPOCH, PRUNE_END_EPOCH);
+        std::cerr << "Warning: only " << EPOCHS << " epoch(s); pruning ramp shortened to reach its targets in epoch "
+                  << PRUNE_END_EPOCH + 1 << std::endl;
+    }
+
+    if (check_grads) {
+        int count = std::min(BATCH_SIZE, dataset.train_data.num_images);
+        return check_grad_accumulation(network, dataset, count, micro_batch > 0 ? micro_batch : 1) ? 0 : 1;
+    }
+
+    // Rank 0 restores the checkpoint before forking, so every worker starts from it
+    int start_epoch = 0;
+    if (resume) {
+        if (!load_checkpoint(checkpoint_path, network, start_epoch, learning_rate)) return 1;
+        std::cout << "Resumed from " << checkpoint_path << " at epoch " << start_epoch + 1 << std::endl;
+    }
+
+    // Workers are forked after the dataset and network exist, so each one shares the
+    // loaded images copy-on-write and starts from identical weights.
+    ShmWorld world;
+    if (num_procs > 1) {
+        if (!world.create(num_procs, network.parameters().size(), use_fp16)) return 1;
+        if (!world.spawn()) {
+            world.destroy();
+            return 1;
+        }
+    }
+    const bool is_root = (world.rank == 0);
+    const int num_train = dataset.train_data.num_images;
+
+    if (is_root) {
+        std::cout << "Starting training with " << world.world_size << " process(es)"
+                  << (world.world_size > 1 && use_fp16 ? ", fp16 gradients" : "") << "..." << std::endl;
+    }
 
-    for (int epoch = 0; epoch < EPOCHS; ++epoch) {
+    for (int epoch = start_epoch; epoch < EPOCHS; ++epoch) {
+        // Prune at the start of the epoch so the remaining epochs fine-tune the survivors
+        if (!prune_sparsity.empty()) {
+            std::vector<double> epoch_sparsity;
+            for (double s : prune_sparsity) {
+                epoch_sparsity.push_back(scheduled_sparsity(s, epoch, PRUNE_START_EPOCH, PRUNE_END_EPOCH));
+            }
+            network.prune(epoch_sparsity);
+        }
+
+        auto epoch_start = std::chrono::steady_clock::now();
+        Graph::reset_peak();
+        double all_reduce_seconds = 0.0;
         float total_epoch_loss = 0.0f;
         int batches_processed = 0;
 
         // Shuffle training data (optional but recommended)
         // For simplicity, not implemented here, but consider shuffling dataset.train_data.images and dataset.train_labels together.
 
-        for (int i = 0; i < dataset.train_data.num_images; i += BATCH_SIZE) {
+        // Every rank walks the same global batches a single process would and
+        // trains on its own slice of each one. Step count, batch size and learning
+        // rate therefore don't depend on the number of processes, and no sample is dropped.
+        for (int i = 0; i < num_train; i += BATCH_SIZE) {
             network.zero_grad(); // Zero gradients for all parameters in the network
-            
-            Value accumulated_batch_loss = Value(0.0, {}, [](){}, "batch_loss_acc");
-            int actual_batch_size = 0;
-
-            for (int j = 0; j < BATCH_SIZE && (i + j) < dataset.train_data.num_images; ++j) {
-                actual_batch_size++;
-                int image_idx = i + j;
-
-                // Prepare input: convert vector<double> to vector<Value>
-                std::vector<Value> input_values;
-                input_values.reserve(INPUT_SIZE);
-                for (int k = 0; k < INPUT_SIZE; ++k) {
-                    // Assuming dataset.train_data.images[image_idx] is already a flat vector<double>
-                    input_values.push_back(Value(dataset.train_data.images[image_idx][k], {}, [](){}, "input_pixel"));
-                }
-
-                // Forward pass
-                std::vector<Value> logits = network.forward_pass(input_values);
-                std::vector<Value> probabilities = softmax(logits);
-
-                // Compute loss for this single sample
-                int target_label = dataset.train_labels[image_idx];
-                Value sample_loss = cross_entropy_loss(probabilities, target_label);
-                accumulated_batch_loss = accumulated_batch_loss + sample_loss;
+
+            int actual_batch_size = std::min(BATCH_SIZE, num_train - i);
+            int local_begin = i + world.rank * actual_batch_size / world.world_size;
+            int local_end = i + (world.rank + 1) * actual_batch_size / world.world_size;
+            double batch_loss = 0.0;
+            if (local_end > local_begin) {
+                batch_loss = accumulate_batch_grads(network, dataset.train_data, dataset.train_labels,
+                                                    local_begin, local_end - local_begin, micro_batch);
             }
 
-            if (actual_batch_size == 0) continue;
+            std::vector<Value*> params = network.parameters();
 
-            // Average loss over the batch
-            Value batch_size_val(static_cast<double>(actual_batch_size), {}, [](){}, "batch_size_val");
-            Value average_batch_loss = accumulated_batch_loss / batch_size_val; 
-            total_epoch_loss += average_batch_loss.data;
-            batches_processed++;
+            // Sum the slices across ranks, each weighted by its share of the batch, so
+            // every replica steps on the gradient of the global batch mean
+            if (world.world_size > 1) {
+                auto reduce_start = std::chrono::steady_clock::now();
+                double share = static_cast<double>(local_end - local_begin) / actual_batch_size;
+                std::vector<double> grads(params.size());
+                for (size_t p = 0; p < params.size(); ++p) grads[p] = params[p]->grad * share;
+                if (!world.all_reduce(grads)) return abort_training(world);
+                for (size_t p = 0; p < params.size(); ++p) params[p]->grad = grads[p];
+                // The loss goes separately at full precision so --fp16 doesn't round what is reported
+                batch_loss *= share;
+                if (!world.all_reduce_scalar(batch_loss)) return abort_training(world);
+                all_reduce_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - reduce_start).count();
+            }
 
-            // Backward pass (on the averaged batch loss)
-            average_batch_loss.backward();
+            total_epoch_loss += batch_loss;
+            batches_processed++;
 
             // Update parameters (SGD)
-            for (Value* param : network.parameters()) {
+            for (Value* param : params) {
                 param->data -= learning_rate * param->grad;
             }
 
-            if ((batches_processed % 100) == 0) { // Print progress every 100 batches
+            if (is_root && (batches_processed % 100) == 0) { // Print progress every 100 batches
                 std::cout << "Epoch: " << epoch + 1 << "/" << EPOCHS 
                           << ", Batch: " << batches_processed 
-                          << ", Avg Batch Loss: " << std::fixed << std::setprecision(4) << average_batch_loss.data 
+                          << ", Avg Batch Loss: " << std::fixed << std::setprecision(4) << batch_loss 
                           << std::endl;
             }
         }
 
+        // Learning rate decay
+        learning_rate *= 0.95; // Decay learning rate by 5% each epoch
+
+        // Only rank 0 reports, evaluates and checkpoints; the others wait at the barrier
+        if (!is_root) {
+            if (!world.barrier()) return abort_training(world);
+            continue;
+        }
+
+        double epoch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_start).count();
         float avg_epoch_loss = (batches_processed > 0) ? (total_epoch_loss / batches_processed) : 0.0f;
-        std::cout << "Epoch: " << epoch + 1 << " completed. Average Epoch Loss: " << std::fixed << std::setprecision(4) << avg_epoch_loss << std::endl;
+        std::cout << "Epoch: " << epoch + 1 << " completed. Average Epoch Loss: " << std::fixed << std::setprecision(4) << avg_epoch_loss
+                  << ", Time: " << std::setprecision(2) << epoch_seconds << "s" << std::endl;
+        std::cout << "  Throughput: " << std::setprecision(1) << num_train / epoch_seconds
+                  << " samples/s across " << world.world_size << " process(es), all-reduce "
+                  << std::setprecision(2) << all_reduce_seconds << "s" << std::endl;
+        std::cout << "  Peak graph nodes: " << Graph::peak()
+                  << (micro_batch > 0 ? " (micro-batch " + std::to_string(micro_batch) + ")" : std::string(" (whole-batch graph)"))
+                  << std::endl;
+        report_sparsity(network);
 
         // Evaluate on test set after each epoch
         int correct_predictions = 0;
         for (int i = 0; i < dataset.test_data.num_images; ++i) {
-            std::vector<Value> test_image_values;
-            test_image_values.reserve(INPUT_SIZE);
-            for (int k = 0; k < INPUT_SIZE; ++k) {
-                test_image_values.push_back(Value(dataset.test_data.images[i][k], {}, [](){}, "test_pixel"));
-            }
-            int predicted_label = predict(network, test_image_values);
+            int predicted_label = predict(network, dataset.test_data.images[i]);
             if (predicted_label == dataset.test_labels[i]) {
                 correct_predictions++;
             }
         }
         double accuracy = static_cast<double>(correct_predictions) / dataset.test_data.num_images;
         std::cout << "Test Accuracy after Epoch " << epoch + 1 << ": " << std::fixed << std::setprecision(4) << (accuracy * 100.0) << "%" << std::endl;
-    
-        // Learning rate decay
-        learning_rate *= 0.95; // Decay learning rate by 5% each epoch
+
+        if (!checkpoint_path.empty() && save_checkpoint(checkpoint_path, network, epoch + 1, learning_rate)) {
+            std::cout << "  Checkpoint saved to " << checkpoint_path << std::endl;
+        }
+        if (!world.barrier()) return abort_training(world);
     }
 
+    if (!is_root) {
+        world.destroy();
+        return 0;
+    }
+    bool workers_ok = world.join();
+    world.destroy();
+    if (!workers_ok) return 1;
+
     std::cout << "Training finished." << std::endl;
 
     // Example of predicting a single image (e.g., first test image)
     if (dataset.test_data.num_images > 0) {
-        std::vector<Value> single_test_image;
-        single_test_image.reserve(INPUT_SIZE);
-        for(int k=0; k < INPUT_SIZE; ++k) {
-            single_test_image.push_back(Value(dataset.test_data.images[0][k], {}, [](){}, ""));
-        }
-        int final_prediction = predict(network, single_test_image);
+        int final_prediction = predict(network, dataset.test_data.images[0]);
         std::cout << "Prediction for the first test image: " << final_prediction 
                   << " | Actual label: " << static_cast<int>(dataset.test_labels[0]) << std::endl;
     }